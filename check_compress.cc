@@ -0,0 +1,140 @@
+#include "compress.hh"
+#include "payload.hh"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+// Round-trip and malformed-input checks for the LZ codec and FrameDecoder,
+// which parse bytes straight off the network. Run via 'make check', which
+// builds this with sanitizers so memory errors fail the target too.
+
+static int failures=0;
+
+static void fail(const string& what) {
+    cerr<<"FAIL: "<<what<<"\n";
+    ++failures;
+}
+
+static string textPayload(size_t size) {
+    static const char* words[]={"client ","server ","negotiation ","port ","transfer ",
+                                "complete\n","throughput ","policy ","FCFS ","RR "};
+    string out;
+    uint32_t state=12345;
+    while(out.size()<size) {
+        state=state*1103515245+12345;
+        out+=words[(state>>16)%10];
+    }
+    out.resize(size);
+    return out;
+}
+
+static string encode(const string& data) {
+    string wire;
+    for(size_t off=0;off<data.size();off+=kCompressionChunkBytes) {
+        appendCompressedFrame(wire,data.data()+off,min(kCompressionChunkBytes,data.size()-off));
+    }
+    if(data.empty()) appendCompressedFrame(wire,data.data(),0);
+    return wire;
+}
+
+// Feeds the wire bytes in pieces of 'step' bytes and returns the decoded output.
+static string decode(const string& wire,size_t step) {
+    string out;
+    FrameDecoder decoder;
+    for(size_t off=0;off<wire.size();off+=step) {
+        decoder.feed(wire.data()+off,min(step,wire.size()-off),
+                     [&](const char* data,size_t length){ out.append(data,length); });
+    }
+    return out;
+}
+
+static void checkRoundTrip(const string& name,const string& data) {
+    string wire=encode(data);
+    for(size_t step:{size_t(1),size_t(7),size_t(4096),wire.size()+1}) {
+        try {
+            if(decode(wire,step)!=data) {
+                fail(name+" ("+to_string(data.size())+" bytes, feed "+to_string(step)+") differs");
+            }
+        } catch(const exception& e) {
+            fail(name+" ("+to_string(data.size())+" bytes, feed "+to_string(step)+") threw "+e.what());
+        }
+    }
+}
+
+// Corrupt input must either decode to something or throw invalid_argument;
+// the sanitizers catch anything worse.
+static void checkMalformed(const string& wire,uint32_t seed) {
+    uint32_t state=seed;
+    for(int round=0;round<2000;++round) {
+        string bad=wire;
+        state=state*1103515245+12345;
+        int flips=1+(state>>28)%4;
+        for(int f=0;f<flips;++f) {
+            state=state*1103515245+12345;
+            size_t pos=(state>>8)%bad.size();
+            bad[pos]^=static_cast<char>(1<<((state>>4)%8));
+        }
+        state=state*1103515245+12345;
+        if((state>>30)==0) bad.resize((state>>8)%bad.size());
+        try {
+            decode(bad,1+(state>>20)%64);
+        } catch(const invalid_argument&) {
+        } catch(const exception& e) {
+            fail(string("malformed input threw unexpected ")+e.what());
+        }
+    }
+}
+
+int main() {
+    const size_t chunk=kCompressionChunkBytes;
+    checkRoundTrip("constant",PayloadPattern::parse("constant").generate(chunk,0));
+    checkRoundTrip("random",PayloadPattern::parse("random:9").generate(chunk,0));
+    checkRoundTrip("text",textPayload(chunk));
+    checkRoundTrip("text multi-chunk",textPayload(5*chunk+123));
+
+    // Literal and match length nibbles saturate at 15 (+4 for matches), and
+    // extensions roll over at 255
+    for(size_t size:{0,1,4,5,15,16,19,20,255,270,271,1000}) {
+        checkRoundTrip("constant",PayloadPattern::parse("constant").generate(size,0));
+        checkRoundTrip("random",PayloadPattern::parse("random:3").generate(size,0));
+        checkRoundTrip("text",textPayload(size));
+    }
+
+    // The hash table is reused between blocks, so a short block compressed right
+    // after a long one sees stale positions beyond its own end
+    for(size_t size:{5,19,300,4000}) {
+        checkRoundTrip("text after long block",textPayload(chunk));
+        checkRoundTrip("text after long block",textPayload(size));
+    }
+
+    // Incompressible chunks must fall back to stored frames
+    string random=PayloadPattern::parse("random:5").generate(chunk,0);
+    if(encode(random).size()!=chunk+2*sizeof(uint32_t)) {
+        fail("random chunk was not stored raw");
+    }
+
+    checkMalformed(encode(textPayload(3*chunk)),1);
+    checkMalformed(encode(PayloadPattern::parse("constant").generate(chunk,0)),2);
+    checkMalformed(encode(random),3);
+
+    // A header claiming an oversized frame is rejected before buffering
+    uint32_t header[2]={0x7FFFFFFF,16};
+    string hostile(reinterpret_cast<const char*>(header),sizeof(header));
+    try {
+        decode(hostile,hostile.size());
+        fail("oversized frame header accepted");
+    } catch(const invalid_argument&) {
+    }
+
+    if(failures>0) {
+        cerr<<failures<<" compression check(s) failed\n";
+        return 1;
+    }
+    cout<<"compression checks passed\n";
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "message.hh"
 #include "client.hh"
+#include "crc32c.hh"
+#include "compress.hh"
 #include <iostream>
 #include <cstring>
 #include <sys/socket.h>
@@ -9,22 +11,64 @@
 #include <stdexcept>
 #include <vector>
 #include <sstream>
+#include <algorithm>
 
 using namespace std;
 
+static bool sendAll(int sock,const char* data,size_t length) {
+    size_t totalSent=0;
+    while(totalSent<length) {
+        ssize_t sent=send(sock,data+totalSent,length-totalSent,0);
+        if(sent<=0) return false;
+        totalSent+=sent;
+    }
+    return true;
+}
+
+CompletionStatus Client::checkCompletion(const char* buffer,int length,int dataPort) {
+    if(length<=0) {
+        cerr<<"Error: no completion from server on port "<<dataPort<<"\n";
+        return COMPLETION_MISSING;
+    }
+    try {
+        Message completion=Message::deserialize(buffer,length);
+        if(completion.messageType==4) return COMPLETION_OK;
+        if(completion.messageType==5) {
+            cerr<<"Error: "<<completion.messageContent<<" on port "<<dataPort<<"\n";
+            return COMPLETION_MISMATCH;
+        }
+        cerr<<"Error: unexpected completion type "<<completion.messageType<<" on port "<<dataPort<<"\n";
+    } catch(const exception& e) {
+        cerr<<"Error: malformed completion on port "<<dataPort<<": "<<e.what()<<"\n";
+    }
+    return COMPLETION_MISSING;
+}
+
 bool Client::transferAllMessages() {
     pid_t clientPid=getpid();
     
     cout<<"Client PID "<<clientPid<<" starting "<<numMessages
-        <<" messages of "<<messageSizeKB<<"KB each via "<<protocol<<endl;
+        <<" messages of "<<messageSizeKB<<"KB each via "<<protocol
+        <<" (tuning profile '"<<tuning.name<<"', payload "<<payloadPattern.describe()
+        <<", compression "<<compressionModeName(requestedCompression)<<")"<<endl;
+    TuningProfile::pinCurrentThread(tuning.workerCpu,"worker");
+    int integrityFailures=0;
+    int missingCompletions=0;
+    size_t totalLogicalBytes=0;
+    size_t totalWireBytes=0;
 
     for(int i=0;i<numMessages;++i) {
+        // Prepare data up front so its checksum can travel with the negotiation
+        string data=payloadPattern.generate(static_cast<size_t>(messageSizeKB)*1024,i);
+        uint32_t dataCrc=crc32c(0,data.data(),data.size());
+
         // Create negotiation socket for each message
         int negotiationSocket=socket(AF_INET,SOCK_STREAM,0);
         if(negotiationSocket<0) {
             cerr<<"Error: Could not create negotiation socket.\n";
             return false;
         }
+        tuning.applyToSocket(negotiationSocket,true);
 
         // Connect to server for negotiation
         sockaddr_in serverAddr{};
@@ -40,7 +84,8 @@ bool Client::transferAllMessages() {
 
         // Send negotiation request
         stringstream ss;
-        ss<<protocol<<" "<<messageSizeKB<<" "<<clientPid;
+        ss<<protocol<<" "<<messageSizeKB<<" "<<clientPid<<" "<<hex<<dataCrc
+          <<" "<<compressionModeName(requestedCompression)<<" "<<tuning.name;
         Message request(1,ss.str());
 
         vector<char> serializedRequest=request.serialize();
@@ -59,8 +104,9 @@ bool Client::transferAllMessages() {
             return false;
         }
 
-        // Parse response to get data port
+        // Parse response to get data port and the compression mode the server agreed to
         int dataPort=0;
+        CompressionMode compression=COMPRESSION_NONE;
         try {
             Message response=Message::deserialize(buffer,bytesRead);
             if(response.messageType!=2) {
@@ -68,7 +114,10 @@ bool Client::transferAllMessages() {
                 close(negotiationSocket);
                 return false;
             }
-            dataPort=stoi(response.messageContent);
+            stringstream rs(response.messageContent);
+            string agreed;
+            if(!(rs>>dataPort)) throw invalid_argument("missing data port");
+            if(rs>>agreed) compression=parseCompressionMode(agreed);
         } catch(const exception& e) {
             cerr<<"Error: Invalid negotiation response: "<<e.what()<<"\n";
             close(negotiationSocket);
@@ -77,20 +126,20 @@ bool Client::transferAllMessages() {
 
         close(negotiationSocket);
 
-        // Prepare data to send
-        string data(messageSizeKB*1024,'A');
         sockaddr_in dataServerAddr{};
         dataServerAddr.sin_family=AF_INET;
         dataServerAddr.sin_port=htons(dataPort);
         inet_pton(AF_INET,serverIpAddress.c_str(),&dataServerAddr.sin_addr);
 
         // Send data via TCP or UDP
+        CompletionStatus status=COMPLETION_OK;
         if(protocol=="tcp") {
             int dataSocket=socket(AF_INET,SOCK_STREAM,0);
             if(dataSocket<0) {
                 cerr<<"Error: creating data TCP socket\n";
                 return false;
             }
+            tuning.applyToSocket(dataSocket,true);
 
             if(::connect(dataSocket,(struct sockaddr*)&dataServerAddr,sizeof(dataServerAddr))<0) {
                 perror("TCP data connect failed");
@@ -99,21 +148,30 @@ bool Client::transferAllMessages() {
                 return false;
             }
 
-            // Send all data
-            size_t totalSent=0;
-            while(totalSent<data.size()) {
-                ssize_t sent=send(dataSocket,data.data()+totalSent,data.size()-totalSent,0);
-                if(sent<=0) {
-                    perror("TCP send failed");
-                    close(dataSocket);
-                    return false;
+            // Send all data, compressing one chunk at a time so the wire stays busy
+            bool sentOk=true;
+            if(compression==COMPRESSION_NONE) {
+                sentOk=sendAll(dataSocket,data.data(),data.size());
+                totalWireBytes+=data.size();
+            } else {
+                string frame;
+                for(size_t off=0;sentOk&&off<data.size();off+=kCompressionChunkBytes) {
+                    frame.clear();
+                    appendCompressedFrame(frame,data.data()+off,min(kCompressionChunkBytes,data.size()-off));
+                    sentOk=sendAll(dataSocket,frame.data(),frame.size());
+                    totalWireBytes+=frame.size();
                 }
-                totalSent+=sent;
+            }
+            if(!sentOk) {
+                perror("TCP send failed");
+                close(dataSocket);
+                return false;
             }
 
             // Receive final response
-            recv(dataSocket,buffer,sizeof(buffer),0);
+            bytesRead=recv(dataSocket,buffer,sizeof(buffer),0);
             close(dataSocket);
+            status=checkCompletion(buffer,bytesRead,dataPort);
 
         } else if(protocol=="udp") {
             int dataSocket=socket(AF_INET,SOCK_DGRAM,0);
@@ -122,12 +180,25 @@ bool Client::transferAllMessages() {
                 return false;
             }
 
-            // Set larger send buffer for UDP
-            int bufferSize=messageSizeKB*1024+2048;
-            setsockopt(dataSocket,SOL_SOCKET,SO_SNDBUF,&bufferSize,sizeof(bufferSize));
+            // A datagram is sent whole, so all compressed frames go out together
+            string wire;
+            if(compression!=COMPRESSION_NONE) {
+                for(size_t off=0;off<data.size();off+=kCompressionChunkBytes) {
+                    appendCompressedFrame(wire,data.data()+off,min(kCompressionChunkBytes,data.size()-off));
+                }
+            }
+            const string& datagram=(compression==COMPRESSION_NONE)? data:wire;
+            totalWireBytes+=datagram.size();
+
+            // Set larger send buffer for UDP, unless the profile already asks for more
+            tuning.applyToSocket(dataSocket,false);
+            int bufferSize=static_cast<int>(datagram.size())+2048;
+            if(bufferSize>tuning.sendBufferBytes) {
+                TuningProfile::setSendBufferSize(dataSocket,bufferSize);
+            }
 
             // Send data
-            if(sendto(dataSocket,data.data(),data.size(),0,
+            if(sendto(dataSocket,datagram.data(),datagram.size(),0,
                       (struct sockaddr*)&dataServerAddr,sizeof(dataServerAddr))<0) {
                 perror("UDP sendto failed");
                 cerr<<"Error: sending UDP data to port "<<dataPort<<"\n";
@@ -136,21 +207,72 @@ bool Client::transferAllMessages() {
             }
 
             // Receive final response
-            recvfrom(dataSocket,buffer,sizeof(buffer),0,nullptr,nullptr);
+            bytesRead=recvfrom(dataSocket,buffer,sizeof(buffer),0,nullptr,nullptr);
             close(dataSocket);
+            status=checkCompletion(buffer,bytesRead,dataPort);
         }
 
+        totalLogicalBytes+=data.size();
+        // Keep going so one run reports every bad message, but fail at the end
+        if(status==COMPLETION_MISMATCH) {
+            ++integrityFailures;
+            cout<<"Message "<<(i+1)<<"/"<<numMessages
+                <<" arrived corrupted on port "<<dataPort<<"\n";
+            continue;
+        }
+        if(status==COMPLETION_MISSING) {
+            ++missingCompletions;
+            cout<<"Message "<<(i+1)<<"/"<<numMessages
+                <<" was not confirmed by the server on port "<<dataPort<<"\n";
+            continue;
+        }
         cout<<"Message "<<(i+1)<<"/"<<numMessages
             <<" sent successfully on port "<<dataPort<<"\n";
     }
 
-    cout<<"Client PID "<<clientPid<<" completed all "<<numMessages<<" messages.\n";
-    return true;
+    cout<<"Client PID "<<clientPid<<" completed all "<<numMessages<<" messages"
+        <<" ("<<totalLogicalBytes<<" logical bytes, "<<totalWireBytes<<" on the wire).\n";
+    if(integrityFailures>0) {
+        cerr<<"Error: server reported "<<integrityFailures<<" payload checksum mismatch(es).\n";
+    }
+    if(missingCompletions>0) {
+        cerr<<"Error: "<<missingCompletions<<" message(s) got no completion from the server.\n";
+    }
+    return integrityFailures==0&&missingCompletions==0;
 }
 
 int main(int argc,char* argv[]) {
-    if(argc!=6) {
-        cerr<<"Usage: "<<argv[0]<<" <Server IP> <Server Port> <Mode (tcp/udp)> <Message Size KB> <Num Messages>\n";
+    // Optional "--flag value" pairs follow the five positional arguments
+    string profileArg="default";
+    string patternArg="constant";
+    string compressArg="none";
+    bool badFlags=(argc<6||(argc-6)%2!=0);
+    for(int i=6;!badFlags&&i+1<argc;i+=2) {
+        string flag=argv[i];
+        if(flag=="--profile") profileArg=argv[i+1];
+        else if(flag=="--pattern") patternArg=argv[i+1];
+        else if(flag=="--compress") compressArg=argv[i+1];
+        else badFlags=true;
+    }
+    if(badFlags) {
+        cerr<<"Usage: "<<argv[0]<<" <Server IP> <Server Port> <Mode (tcp/udp)> <Message Size KB> <Num Messages>"
+            <<" [--profile <name|file>] [--pattern <constant|random[:seed]|file:path>]"
+            <<" [--compress <none|lz>]\n";
+        cerr<<"Built-in profiles:";
+        for(const string& name:TuningProfile::presetNames()) cerr<<" "<<name;
+        cerr<<"\n";
+        return 1;
+    }
+
+    TuningProfile profile;
+    PayloadPattern pattern;
+    CompressionMode compression=COMPRESSION_NONE;
+    try {
+        profile=TuningProfile::load(profileArg);
+        pattern=PayloadPattern::parse(patternArg);
+        compression=parseCompressionMode(compressArg);
+    } catch(const exception& e) {
+        cerr<<"Error: "<<e.what()<<"\n";
         return 1;
     }
 
@@ -170,7 +292,7 @@ int main(int argc,char* argv[]) {
         return 1;
     }
 
-    Client client(serverIp,port,messageSize,protocol,numMessages);
+    Client client(serverIp,port,messageSize,protocol,numMessages,profile,pattern,compression);
     if(!client.transferAllMessages()) {
         cerr<<"Transfer failed.\n";
         return 1;
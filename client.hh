@@ -2,27 +2,46 @@
 #define CLIENT_HH
 
 #include "message.hh"
+#include "tuning.hh"
+#include "payload.hh"
+#include "compress.hh"
 #include <string>
 
+// Server's verdict on one data transfer; MISSING covers no reply or an unreadable one.
+enum CompletionStatus {COMPLETION_OK, COMPLETION_MISMATCH, COMPLETION_MISSING};
+
 class Client {
 public:
-    Client(const std::string& ip,int tcpPort,int sizeKB,const std::string& proto,int num):
+    Client(const std::string& ip,int tcpPort,int sizeKB,const std::string& proto,int num,
+           const TuningProfile& profile=TuningProfile(),
+           const PayloadPattern& pattern=PayloadPattern(),
+           CompressionMode compression=COMPRESSION_NONE):
         serverIpAddress(ip),
         serverTcpPort(tcpPort),
         messageSizeKB(sizeKB),
         protocol(proto),
-        numMessages(num)
+        numMessages(num),
+        tuning(profile),
+        payloadPattern(pattern),
+        requestedCompression(compression)
     {}
 
     bool transferAllMessages();
 
 private:
+    // transferAllMessages() fails unless every message completes with COMPLETION_OK.
+    CompletionStatus checkCompletion(const char* buffer,int length,int dataPort);
+
     std::string serverIpAddress;
     // The TCP port number used to connect to the server.
     int serverTcpPort;
     int messageSizeKB;
     std::string protocol;
     int numMessages;
+    TuningProfile tuning;
+    PayloadPattern payloadPattern;
+    // Asked for during negotiation; the server's reply decides what is used.
+    CompressionMode requestedCompression;
 };
 
 
@@ -0,0 +1,213 @@
+#include "compress.hh"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace std;
+
+
+namespace {
+
+const size_t kMinMatch=4;
+const size_t kMaxOffset=65535;
+const int kHashBits=12;
+const size_t kFrameHeaderBytes=2*sizeof(uint32_t);
+// Upper bound a decoder accepts for one frame, so a corrupt header cannot
+// make it buffer unbounded data.
+const size_t kMaxFrameBytes=1024*1024;
+
+inline uint32_t hash4(uint32_t v) {
+    return (v*2654435761u)>>(32-kHashBits);
+}
+
+// Writes a length in LZ4's 255-continuation form; false if out of space.
+inline bool writeLengthExtension(uint8_t*& op,const uint8_t* oend,size_t extra) {
+    while(extra>=255) {
+        if(op>=oend) return false;
+        *op++=255;
+        extra-=255;
+    }
+    if(op>=oend) return false;
+    *op++=static_cast<uint8_t>(extra);
+    return true;
+}
+
+inline size_t readLengthExtension(const uint8_t*& ip,const uint8_t* iend) {
+    size_t extra=0;
+    uint8_t b;
+    do {
+        if(ip>=iend) throw invalid_argument("Truncated length in compressed block");
+        b=*ip++;
+        extra+=b;
+    } while(b==255);
+    return extra;
+}
+
+// Emits literals [anchor,ip) and, if matchLength>0, a match back by offset.
+bool emitSequence(uint8_t*& op,const uint8_t* oend,const uint8_t* anchor,size_t literals,
+                  size_t offset,size_t matchLength) {
+    if(op>=oend) return false;
+    uint8_t* token=op++;
+    *token=static_cast<uint8_t>((literals>=15? 15:literals)<<4);
+    if(literals>=15&&!writeLengthExtension(op,oend,literals-15)) return false;
+    if(static_cast<size_t>(oend-op)<literals) return false;
+    memcpy(op,anchor,literals);
+    op+=literals;
+
+    if(matchLength==0) return true;
+    if(oend-op<2) return false;
+    *op++=static_cast<uint8_t>(offset&0xFF);
+    *op++=static_cast<uint8_t>(offset>>8);
+    size_t code=matchLength-kMinMatch;
+    *token|=static_cast<uint8_t>(code>=15? 15:code);
+    if(code>=15&&!writeLengthExtension(op,oend,code-15)) return false;
+    return true;
+}
+
+} // namespace
+
+CompressionMode parseCompressionMode(const string& name) {
+    if(name=="none") return COMPRESSION_NONE;
+    if(name=="lz") return COMPRESSION_LZ;
+    throw invalid_argument("Unknown compression mode: "+name);
+}
+
+string compressionModeName(CompressionMode mode) {
+    return (mode==COMPRESSION_LZ)? "lz":"none";
+}
+
+size_t lzCompressBound(size_t length) {
+    return length+length/255+16;
+}
+
+size_t lzCompressBlock(const char* src,size_t length,char* dst,size_t capacity) {
+    const uint8_t* in=reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* ip=in;
+    const uint8_t* end=in+length;
+    const uint8_t* anchor=in;
+    uint8_t* op=reinterpret_cast<uint8_t*>(dst);
+    const uint8_t* oend=op+capacity;
+
+    // Reused across blocks instead of reallocated and zeroed per 16 KB chunk.
+    // Stale entries are harmless: a position is only trusted if it lies before
+    // ip within the window, and its bytes are compared before use.
+    static thread_local uint32_t table[size_t(1)<<kHashBits];
+    while(end-ip>=static_cast<ptrdiff_t>(kMinMatch)) {
+        uint32_t pos=static_cast<uint32_t>(ip-in);
+        uint32_t seq;
+        memcpy(&seq,ip,4);
+        uint32_t h=hash4(seq);
+        uint32_t candidatePos=table[h];
+        table[h]=pos;
+
+        bool found=false;
+        if(candidatePos<pos&&pos-candidatePos<=kMaxOffset) {
+            uint32_t candidateSeq;
+            memcpy(&candidateSeq,in+candidatePos,4);
+            found=(candidateSeq==seq);
+        }
+        if(found) {
+            const uint8_t* candidate=in+candidatePos;
+            const uint8_t* m=ip+kMinMatch;
+            const uint8_t* c=candidate+kMinMatch;
+            while(m<end&&*m==*c) {
+                ++m;
+                ++c;
+            }
+            if(!emitSequence(op,oend,anchor,ip-anchor,ip-candidate,m-ip)) return 0;
+            ip=m;
+            anchor=ip;
+        } else {
+            // Step faster through data that keeps missing, like LZ4's acceleration;
+            // clamped so ip never moves past end
+            size_t step=1+((ip-anchor)>>6);
+            ip+=min(step,static_cast<size_t>(end-ip));
+        }
+    }
+    if(!emitSequence(op,oend,anchor,end-anchor,0,0)) return 0;
+    return op-reinterpret_cast<uint8_t*>(dst);
+}
+
+void lzDecompressBlock(const char* src,size_t length,char* dst,size_t rawLength) {
+    const uint8_t* ip=reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* iend=ip+length;
+    uint8_t* out=reinterpret_cast<uint8_t*>(dst);
+    uint8_t* op=out;
+    uint8_t* oend=out+rawLength;
+
+    while(ip<iend) {
+        uint8_t token=*ip++;
+        size_t literals=token>>4;
+        if(literals==15) literals+=readLengthExtension(ip,iend);
+        if(literals>static_cast<size_t>(iend-ip)||literals>static_cast<size_t>(oend-op)) {
+            throw invalid_argument("Literal run overflows compressed block");
+        }
+        memcpy(op,ip,literals);
+        ip+=literals;
+        op+=literals;
+        if(ip==iend) break;
+
+        if(iend-ip<2) throw invalid_argument("Truncated match offset in compressed block");
+        size_t offset=ip[0]|(static_cast<size_t>(ip[1])<<8);
+        ip+=2;
+        if(offset==0||offset>static_cast<size_t>(op-out)) {
+            throw invalid_argument("Invalid match offset in compressed block");
+        }
+        size_t matchLength=token&0x0F;
+        if(matchLength==15) matchLength+=readLengthExtension(ip,iend);
+        matchLength+=kMinMatch;
+        if(matchLength>static_cast<size_t>(oend-op)) {
+            throw invalid_argument("Match overflows decompressed block");
+        }
+        const uint8_t* match=op-offset;
+        if(offset>=matchLength) {
+            memcpy(op,match,matchLength);
+            op+=matchLength;
+        } else {
+            // Overlapping copy repeats the last 'offset' bytes
+            while(matchLength--) *op++=*match++;
+        }
+    }
+    if(op!=oend) throw invalid_argument("Compressed block size mismatch");
+}
+
+void appendCompressedFrame(string& out,const char* data,size_t length) {
+    size_t headerPos=out.size();
+    out.resize(headerPos+kFrameHeaderBytes+lzCompressBound(length));
+    size_t stored=lzCompressBlock(data,length,&out[headerPos+kFrameHeaderBytes],lzCompressBound(length));
+    if(stored==0||stored>=length) {
+        stored=length;
+        memcpy(&out[headerPos+kFrameHeaderBytes],data,length);
+    }
+    uint32_t rawLength=static_cast<uint32_t>(length);
+    uint32_t storedLength=static_cast<uint32_t>(stored);
+    memcpy(&out[headerPos],&rawLength,sizeof(uint32_t));
+    memcpy(&out[headerPos+sizeof(uint32_t)],&storedLength,sizeof(uint32_t));
+    out.resize(headerPos+kFrameHeaderBytes+stored);
+}
+
+void FrameDecoder::feed(const char* data,size_t length,const Sink& sink) {
+    pending.append(data,length);
+    size_t pos=0;
+    while(pending.size()-pos>=kFrameHeaderBytes) {
+        uint32_t rawLength,storedLength;
+        memcpy(&rawLength,pending.data()+pos,sizeof(uint32_t));
+        memcpy(&storedLength,pending.data()+pos+sizeof(uint32_t),sizeof(uint32_t));
+        if(rawLength>kMaxFrameBytes||storedLength>rawLength) {
+            throw invalid_argument("Invalid compressed frame header");
+        }
+        if(pending.size()-pos-kFrameHeaderBytes<storedLength) break;
+
+        const char* body=pending.data()+pos+kFrameHeaderBytes;
+        if(storedLength==rawLength) {
+            sink(body,rawLength);
+        } else {
+            scratch.resize(rawLength);
+            lzDecompressBlock(body,storedLength,&scratch[0],rawLength);
+            sink(scratch.data(),rawLength);
+        }
+        pos+=kFrameHeaderBytes+storedLength;
+    }
+    pending.erase(0,pos);
+}
@@ -0,0 +1,46 @@
+#ifndef COMPRESS_HH
+#define COMPRESS_HH
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Per-transfer payload compression agreed during negotiation.
+enum CompressionMode {COMPRESSION_NONE, COMPRESSION_LZ};
+
+// Accepts "none" or "lz"; throws invalid_argument otherwise.
+CompressionMode parseCompressionMode(const std::string& name);
+std::string compressionModeName(CompressionMode mode);
+
+// Payloads are compressed in independent chunks of this many logical bytes,
+// so the client can send and the server can decode while data is in flight.
+const size_t kCompressionChunkBytes=16*1024;
+
+// Self-contained LZ77 block codec (LZ4-style sequences: a token with literal
+// and match length nibbles, literals, a 16-bit offset, length extensions).
+size_t lzCompressBound(size_t length);
+// Returns the compressed size, or 0 if the output would not fit in capacity.
+size_t lzCompressBlock(const char* src,size_t length,char* dst,size_t capacity);
+// Throws invalid_argument on malformed input or a size mismatch.
+void lzDecompressBlock(const char* src,size_t length,char* dst,size_t rawLength);
+
+// Appends one frame: [RawLength(uint32)][StoredLength(uint32)][Bytes].
+// StoredLength==RawLength means the chunk did not compress and is stored raw.
+void appendCompressedFrame(std::string& out,const char* data,size_t length);
+
+// Reassembles frames from an arbitrarily split byte stream and hands each
+// decompressed chunk to the sink.
+class FrameDecoder {
+public:
+    using Sink=std::function<void(const char*,size_t)>;
+
+    // Throws invalid_argument on a corrupt frame.
+    void feed(const char* data,size_t length,const Sink& sink);
+
+private:
+    std::string pending;
+    std::string scratch;
+};
+
+
+#endif
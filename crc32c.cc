@@ -0,0 +1,190 @@
+#include "crc32c.hh"
+#include <cstring>
+
+#if defined(__x86_64__)&&(defined(__GNUC__)||defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#elif defined(__aarch64__)&&defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM 1
+#endif
+
+using namespace std;
+
+
+namespace {
+
+const uint32_t kPolynomial=0x82F63B78; // reflected Castagnoli
+
+// Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k zero bytes.
+struct Crc32cTables {
+    uint32_t table[8][256];
+
+    Crc32cTables() {
+        for(uint32_t b=0;b<256;++b) {
+            uint32_t crc=b;
+            for(int bit=0;bit<8;++bit) {
+                crc=(crc>>1)^((crc&1)?kPolynomial:0);
+            }
+            table[0][b]=crc;
+        }
+        for(uint32_t b=0;b<256;++b) {
+            for(int k=1;k<8;++k) {
+                table[k][b]=(table[k-1][b]>>8)^table[0][table[k-1][b]&0xFF];
+            }
+        }
+    }
+};
+
+const Crc32cTables& tables() {
+    static const Crc32cTables t;
+    return t;
+}
+
+uint32_t portableKernel(uint32_t crc,const unsigned char* p,size_t length) {
+    const auto& t=tables().table;
+    while(length>=8) {
+        uint32_t lo,hi;
+        memcpy(&lo,p,4);
+        memcpy(&hi,p+4,4);
+#if defined(__BYTE_ORDER__)&&__BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+        lo=__builtin_bswap32(lo);
+        hi=__builtin_bswap32(hi);
+#endif
+        lo^=crc;
+        crc=t[7][lo&0xFF]^t[6][(lo>>8)&0xFF]^t[5][(lo>>16)&0xFF]^t[4][lo>>24]^
+            t[3][hi&0xFF]^t[2][(hi>>8)&0xFF]^t[1][(hi>>16)&0xFF]^t[0][hi>>24];
+        p+=8;
+        length-=8;
+    }
+    while(length--) {
+        crc=(crc>>8)^t[0][(crc^*p++)&0xFF];
+    }
+    return crc;
+}
+
+#if defined(CRC32C_X86)||defined(CRC32C_ARM)
+// The CRC instruction has a latency of several cycles but can issue every
+// cycle, so long buffers are split into three interleaved streams and
+// stitched back together by "shifting" a CRC over a run of zero bytes.
+const size_t kStripe=256;
+
+struct Crc32cShiftTable {
+    uint32_t table[4][256];
+
+    Crc32cShiftTable() {
+        const unsigned char zeros[kStripe]={};
+        for(int k=0;k<4;++k) {
+            for(uint32_t b=0;b<256;++b) {
+                table[k][b]=portableKernel(b<<(8*k),zeros,kStripe);
+            }
+        }
+    }
+};
+
+uint32_t shiftStripe(uint32_t crc) {
+    static const Crc32cShiftTable shift;
+    const auto& t=shift.table;
+    return t[0][crc&0xFF]^t[1][(crc>>8)&0xFF]^t[2][(crc>>16)&0xFF]^t[3][crc>>24];
+}
+#endif
+
+#if defined(CRC32C_X86)
+__attribute__((target("sse4.2")))
+uint32_t hardwareKernel(uint32_t crc,const unsigned char* p,size_t length) {
+    uint64_t crc0=crc;
+    while(length>=3*kStripe) {
+        uint64_t crc1=0,crc2=0;
+        for(size_t i=0;i<kStripe;i+=8) {
+            uint64_t w0,w1,w2;
+            memcpy(&w0,p+i,8);
+            memcpy(&w1,p+kStripe+i,8);
+            memcpy(&w2,p+2*kStripe+i,8);
+            crc0=_mm_crc32_u64(crc0,w0);
+            crc1=_mm_crc32_u64(crc1,w1);
+            crc2=_mm_crc32_u64(crc2,w2);
+        }
+        crc0=shiftStripe(static_cast<uint32_t>(crc0))^crc1;
+        crc0=shiftStripe(static_cast<uint32_t>(crc0))^crc2;
+        p+=3*kStripe;
+        length-=3*kStripe;
+    }
+    while(length>=8) {
+        uint64_t word;
+        memcpy(&word,p,8);
+        crc0=_mm_crc32_u64(crc0,word);
+        p+=8;
+        length-=8;
+    }
+    crc=static_cast<uint32_t>(crc0);
+    while(length--) {
+        crc=_mm_crc32_u8(crc,*p++);
+    }
+    return crc;
+}
+
+bool detectHardware() {
+    return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(CRC32C_ARM)
+uint32_t hardwareKernel(uint32_t crc,const unsigned char* p,size_t length) {
+    while(length>=3*kStripe) {
+        uint32_t crc1=0,crc2=0;
+        for(size_t i=0;i<kStripe;i+=8) {
+            uint64_t w0,w1,w2;
+            memcpy(&w0,p+i,8);
+            memcpy(&w1,p+kStripe+i,8);
+            memcpy(&w2,p+2*kStripe+i,8);
+            crc=__crc32cd(crc,w0);
+            crc1=__crc32cd(crc1,w1);
+            crc2=__crc32cd(crc2,w2);
+        }
+        crc=shiftStripe(crc)^crc1;
+        crc=shiftStripe(crc)^crc2;
+        p+=3*kStripe;
+        length-=3*kStripe;
+    }
+    while(length>=8) {
+        uint64_t word;
+        memcpy(&word,p,8);
+        crc=__crc32cd(crc,word);
+        p+=8;
+        length-=8;
+    }
+    while(length--) {
+        crc=__crc32cb(crc,*p++);
+    }
+    return crc;
+}
+
+bool detectHardware() {
+    return true;
+}
+#else
+uint32_t hardwareKernel(uint32_t crc,const unsigned char* p,size_t length) {
+    return portableKernel(crc,p,length);
+}
+
+bool detectHardware() {
+    return false;
+}
+#endif
+
+} // namespace
+
+bool crc32cHardwareAvailable() {
+    static const bool available=detectHardware();
+    return available;
+}
+
+uint32_t crc32cPortable(uint32_t crc,const void* data,size_t length) {
+    return ~portableKernel(~crc,static_cast<const unsigned char*>(data),length);
+}
+
+uint32_t crc32c(uint32_t crc,const void* data,size_t length) {
+    const unsigned char* p=static_cast<const unsigned char*>(data);
+    if(crc32cHardwareAvailable()) {
+        return ~hardwareKernel(~crc,p,length);
+    }
+    return ~portableKernel(~crc,p,length);
+}
@@ -0,0 +1,18 @@
+#ifndef CRC32C_HH
+#define CRC32C_HH
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli). Calls chain: crc32c(crc32c(0,a),b)==crc32c(0,a+b),
+// so a receiver can verify a stream chunk by chunk.
+uint32_t crc32c(uint32_t crc,const void* data,size_t length);
+
+// Table-driven fallback, always available; exposed for benchmarking.
+uint32_t crc32cPortable(uint32_t crc,const void* data,size_t length);
+
+// True if crc32c() dispatches to the CPU's CRC32 instructions.
+bool crc32cHardwareAvailable();
+
+
+#endif
@@ -0,0 +1,78 @@
+#include "payload.hh"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+
+// splitmix64: small, fast and good enough to make every byte position matter.
+static uint64_t nextRandom(uint64_t& state) {
+    uint64_t z=(state+=0x9E3779B97F4A7C15ULL);
+    z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+    z=(z^(z>>27))*0x94D049BB133111EBULL;
+    return z^(z>>31);
+}
+
+PayloadPattern PayloadPattern::parse(const string& spec) {
+    PayloadPattern p;
+    if(spec=="constant") {
+        p.kind=CONSTANT;
+    } else if(spec=="random"||spec.rfind("random:",0)==0) {
+        p.kind=RANDOM;
+        if(spec.size()>7) {
+            try {
+                size_t pos=0;
+                p.seed=stoull(spec.substr(7),&pos);
+                if(pos!=spec.size()-7) throw invalid_argument(spec);
+            } catch(const exception&) {
+                throw invalid_argument("Invalid random seed in payload pattern: "+spec);
+            }
+        }
+    } else if(spec.rfind("file:",0)==0) {
+        p.kind=FILE_CONTENT;
+        ifstream in(spec.substr(5),ios::binary);
+        if(!in.is_open()) {
+            throw invalid_argument("Cannot open payload file: "+spec.substr(5));
+        }
+        stringstream ss;
+        ss<<in.rdbuf();
+        p.fileContent=ss.str();
+        if(p.fileContent.empty()) {
+            throw invalid_argument("Payload file is empty: "+spec.substr(5));
+        }
+    } else {
+        throw invalid_argument("Unknown payload pattern: "+spec);
+    }
+    return p;
+}
+
+string PayloadPattern::generate(size_t size,int messageIndex) const {
+    string data(size,'A');
+    if(kind==RANDOM) {
+        uint64_t state=seed^(static_cast<uint64_t>(messageIndex)*0xD1B54A32D192ED03ULL);
+        size_t i=0;
+        for(;i+8<=size;i+=8) {
+            uint64_t v=nextRandom(state);
+            memcpy(&data[i],&v,8);
+        }
+        if(i<size) {
+            uint64_t v=nextRandom(state);
+            memcpy(&data[i],&v,size-i);
+        }
+    } else if(kind==FILE_CONTENT) {
+        // Repeat the file to fill the payload, truncating the final copy
+        for(size_t i=0;i<size;i+=fileContent.size()) {
+            memcpy(&data[i],fileContent.data(),min(fileContent.size(),size-i));
+        }
+    }
+    return data;
+}
+
+string PayloadPattern::describe() const {
+    if(kind==RANDOM) return "random:"+to_string(seed);
+    if(kind==FILE_CONTENT) return "file";
+    return "constant";
+}
@@ -0,0 +1,30 @@
+#ifndef PAYLOAD_HH
+#define PAYLOAD_HH
+
+#include <cstdint>
+#include <string>
+
+// Content the client puts on the wire. Replaces the old fixed 'A' fill so
+// that corrupted or reordered data changes the CRC the server verifies.
+class PayloadPattern {
+public:
+    enum Kind {CONSTANT, RANDOM, FILE_CONTENT};
+
+    // Accepts "constant", "random", "random:<seed>" or "file:<path>".
+    // Throws invalid_argument on an unknown spec or unreadable file.
+    static PayloadPattern parse(const std::string& spec);
+
+    // Fills a payload of the given size for the given message index. Random
+    // payloads are reseeded per message so consecutive messages differ.
+    std::string generate(size_t size,int messageIndex) const;
+
+    std::string describe() const;
+
+private:
+    Kind kind=CONSTANT;
+    uint64_t seed=1;
+    std::string fileContent;
+};
+
+
+#endif
@@ -1,5 +1,6 @@
 #include "message.hh"
 #include "server.hh"
+#include "crc32c.hh"
 #include <iostream>
 #include <iomanip>
 #include <cstring>
@@ -12,11 +13,53 @@
 #include <arpa/inet.h>
 #include <sstream>
 #include <algorithm>
+#include <cstdio>
 
 using namespace std;
 
+static const char* kCsvHeader=
+    "Policy,Protocol,MessageSizeKB,TransferTimeMicroseconds,ThroughputKbps,ServerProfile,ClientProfile,Integrity,"
+    "Compression,WireBytes,LogicalBytes,WireThroughputKbps";
+
+// Appends to an existing log only if its header matches the current columns;
+// otherwise the old file is moved aside to <file>.<n>.old so rows never land
+// under the wrong header.
+void Server::openCsvLog(const string& fileName) {
+    string firstLine;
+    {
+        ifstream existing(fileName);
+        if(existing.is_open()) getline(existing,firstLine);
+    }
+    if(!firstLine.empty()&&firstLine.back()=='\r') firstLine.pop_back();
+
+    if(!firstLine.empty()&&firstLine!=kCsvHeader) {
+        string rotated;
+        for(int n=1;;++n) {
+            rotated=fileName+"."+to_string(n)+".old";
+            if(!ifstream(rotated).is_open()) break;
+        }
+        if(rename(fileName.c_str(),rotated.c_str())!=0) {
+            cerr<<"Error: "<<fileName<<" has a different CSV header and could not be moved aside;"
+                <<" performance logging disabled.\n";
+            return;
+        }
+        cout<<fileName<<" has an older CSV header; moved it to "<<rotated<<".\n";
+    }
+
+    csvLogFile.open(fileName,ios_base::app);
+    if(!csvLogFile.is_open()) {
+        cerr<<"Error: could not open CSV log "<<fileName<<"\n";
+        return;
+    }
+    csvLogFile.seekp(0,ios::end);
+    if(csvLogFile.tellp()==0) {
+        csvLogFile<<kCsvHeader<<"\n";
+    }
+}
+
 
 void Server::scheduler() {
+    TuningProfile::pinCurrentThread(tuning.schedulerCpu,"scheduler");
     while(isRunning) {
         ClientRequest clientReq;
         bool hasRequest=false;
@@ -100,6 +143,7 @@ void Server::handleNegotiation(const ClientRequest& clientReq) {
             close(clientReq.clientSocket);
             return;
         }
+        tuning.applyToSocket(dataSocket,clientReq.protocol=="tcp");
 
         sockaddr_in dataAddr{};
         dataAddr.sin_family=AF_INET;
@@ -125,17 +169,20 @@ void Server::handleNegotiation(const ClientRequest& clientReq) {
         {
             lock_guard<mutex> lock(logMutex);
             cout<<"Client (PID "<<clientReq.clientPid<<") negotiated port "<<dataPort 
-                 <<" for "<<clientReq.sizeKB<<"KB "<<clientReq.protocol<<" transfer.\n";
+                 <<" for "<<clientReq.sizeKB<<"KB "<<clientReq.protocol<<" transfer"
+                 <<" (compression "<<compressionModeName(clientReq.compression)<<").\n";
         }
         
-        Message resp(2,to_string(dataPort));
+        // Echo the agreed compression mode so the client knows how to encode
+        Message resp(2,to_string(dataPort)+" "+compressionModeName(clientReq.compression));
         vector<char> respSer=resp.serialize();
         send(clientReq.clientSocket,respSer.data(),respSer.size(),0);
         close(clientReq.clientSocket);
 
         // Handle data transfer synchronously
         handleDataTransfer(clientReq.protocol,clientReq.sizeKB,dataSocket, 
-                         string(client_ip),clientReq.clientPid);
+                         string(client_ip),clientReq.clientPid,clientReq.expectedCrc,
+                         clientReq.compression,clientReq.clientProfile);
 
     } catch(const exception& e) {
         cerr<<"Error during negotiation: "<<e.what()<<"\n";
@@ -144,9 +191,40 @@ void Server::handleNegotiation(const ClientRequest& clientReq) {
 }
 
 void Server::handleDataTransfer(const string& protocol,int sizeKB,int dataSocket,
-                               const string& clientIp,int clientPid) {
+                               const string& clientIp,int clientPid,
+                               optional<uint32_t> expectedCrc,CompressionMode compression,
+                               const string& clientProfile) {
     const size_t totalBytesToReceive=sizeKB*1024;
+    // bytesReceived counts logical (decompressed) bytes, wireBytes what arrived on the socket
     size_t bytesReceived=0;
+    size_t wireBytes=0;
+    // Verified incrementally as data arrives, so no copy of the payload is kept
+    uint32_t crc=0;
+    auto payloadIntact=[&]{
+        return !expectedCrc||(bytesReceived==totalBytesToReceive&&crc==*expectedCrc);
+    };
+    auto consume=[&](const char* data,size_t n){
+        bytesReceived+=n;
+        if(expectedCrc) crc=crc32c(crc,data,n);
+    };
+    FrameDecoder decoder;
+    // Built once so each recv does not wrap the lambda in a fresh std::function
+    const FrameDecoder::Sink consumeSink(consume);
+    // Returns false if the received chunk cannot be decoded
+    auto receiveChunk=[&](const char* data,size_t n){
+        wireBytes+=n;
+        if(compression==COMPRESSION_NONE) {
+            consume(data,n);
+            return true;
+        }
+        try {
+            decoder.feed(data,n,consumeSink);
+            return true;
+        } catch(const exception& e) {
+            cerr<<"Client (PID "<<clientPid<<"): corrupt compressed data: "<<e.what()<<"\n";
+            return false;
+        }
+    };
     auto startTime=chrono::steady_clock::now();
     
     sockaddr_in addr;
@@ -161,19 +239,22 @@ void Server::handleDataTransfer(const string& protocol,int sizeKB,int dataSocket
             cerr<<"Port "<<port<<": Error accepting TCP data connection.\n";
             return;
         }
+        tuning.applyToSocket(acceptedSocket,true);
         char buffer[4096];
         while(bytesReceived<totalBytesToReceive) {
             int n=recv(acceptedSocket,buffer,sizeof(buffer),0);
-            if(n<=0) break;
-            bytesReceived+=n;
+            if(n<=0||!receiveChunk(buffer,n)) break;
+            tuning.rearmQuickAck(acceptedSocket);
         }
-        Message finalResp(4,"TCP transfer complete");
+        Message finalResp=payloadIntact()? Message(4,"TCP transfer complete")
+                                         : Message(5,"TCP transfer checksum mismatch");
         vector<char> finalRespSer=finalResp.serialize();
         send(acceptedSocket,finalRespSer.data(),finalRespSer.size(),0);
         close(acceptedSocket);
 
     } else if(protocol=="udp") {
-        char buffer[32*1024]; 
+        // Room for a 32 KB payload stored uncompressed plus frame headers
+        char buffer[64*1024]; 
         sockaddr_in clientDataAddr{};
         socklen_t clientLen=sizeof(clientDataAddr);
         
@@ -181,26 +262,32 @@ void Server::handleDataTransfer(const string& protocol,int sizeKB,int dataSocket
         while(bytesReceived<totalBytesToReceive) {
             int n=recvfrom(dataSocket,buffer,sizeof(buffer),0, 
                            (struct sockaddr*)&clientDataAddr,&clientLen);
-            if(n<=0) break;
-            bytesReceived+=n;
+            if(n<=0||!receiveChunk(buffer,n)) break;
             if(bytesReceived>=totalBytesToReceive) break;
         }
         
-        Message finalResp(4,"UDP transfer complete");
+        Message finalResp=payloadIntact()? Message(4,"UDP transfer complete")
+                                         : Message(5,"UDP transfer checksum mismatch");
         vector<char> finalRespSer=finalResp.serialize();
         sendto(dataSocket,finalRespSer.data(),finalRespSer.size(),0,
                (struct sockaddr*)&clientDataAddr,clientLen);
         close(dataSocket);
     }
 
+    string integrity=!expectedCrc? "none":(payloadIntact()? "ok":"mismatch");
+
     auto endTime=chrono::steady_clock::now();
     auto duration_us=chrono::duration_cast<chrono::microseconds>(endTime-startTime);
     long long microseconds=duration_us.count();
 
+    // Effective throughput counts logical bytes; wire throughput what the network carried
     double throughputKbps=0;
+    double wireThroughputKbps=0;
     if(microseconds>0) {
         throughputKbps=(static_cast<double>(bytesReceived)*8.0*1000000.0)/ 
                         (static_cast<double>(microseconds)*1024.0);
+        wireThroughputKbps=(static_cast<double>(wireBytes)*8.0*1000000.0)/ 
+                            (static_cast<double>(microseconds)*1024.0);
     }
 
     {
@@ -209,6 +296,15 @@ void Server::handleDataTransfer(const string& protocol,int sizeKB,int dataSocket
         cout<<"Client (PID "<<clientPid<<") on Port "<<port<<" ("<<protocol<<"): "
              <<static_cast<double>(bytesReceived)/1024.0<<" KB in "
              <<microseconds<<"us -> "<<throughputKbps<<" Kbps.\n";
+        if(compression!=COMPRESSION_NONE) {
+            cout<<"Client (PID "<<clientPid<<") on Port "<<port<<": "
+                 <<static_cast<double>(wireBytes)/1024.0<<" KB on the wire ("
+                 <<compressionModeName(compression)<<") -> "<<wireThroughputKbps<<" Kbps.\n";
+        }
+        if(integrity=="mismatch") {
+            cout<<"Client (PID "<<clientPid<<") on Port "<<port<<": payload checksum mismatch"
+                 <<" (expected "<<hex<<*expectedCrc<<", got "<<crc<<dec<<").\n";
+        }
         cout<<"Client (PID "<<clientPid<<") on Port "<<port<<": Disconnected.\n";
 
         if(csvLogFile.is_open()) {
@@ -217,7 +313,15 @@ void Server::handleDataTransfer(const string& protocol,int sizeKB,int dataSocket
                       <<protocol<<","
                       <<sizeKB<<","
                       <<microseconds<<","
-                      <<throughputKbps<<"\n";
+                      <<throughputKbps<<","
+                      <<tuning.name<<","
+                      <<clientProfile<<","
+                      <<integrity<<","
+                      <<compressionModeName(compression)<<","
+                      <<wireBytes<<","
+                      <<bytesReceived<<","
+                      <<wireThroughputKbps<<"\n";
+            csvLogFile.flush();
         }
     }
 }
@@ -230,6 +334,7 @@ bool Server::initialize(){
     }
     int opt=1;
     setsockopt(tcpSocket,SOL_SOCKET,SO_REUSEADDR,&opt,sizeof(opt));
+    tuning.applyToSocket(tcpSocket,true);
     sockaddr_in serverAddr{};
     serverAddr.sin_family=AF_INET;
     serverAddr.sin_addr.s_addr=INADDR_ANY;
@@ -249,10 +354,14 @@ void Server::start(){
     }
     
     string policyName=(schedulingPolicy==FCFS)?"FCFS":"RR";
-    cout<<"Server listening on port "<<tcpPort<<" with "<<policyName<<" scheduling...\n";
+    cout<<"Server listening on port "<<tcpPort<<" with "<<policyName<<" scheduling"
+        <<" (tuning profile '"<<tuning.name<<"')...\n";
 
+    // Start the scheduler before pinning this thread: new threads inherit the
+    // creator's affinity, and an unpinned scheduler must not land on the accept core.
     isRunning=true;
     schedulerThread=thread(&Server::scheduler,this);
+    TuningProfile::pinCurrentThread(tuning.acceptCpu,"accept");
 
     while(isRunning){
         sockaddr_in clientAddr{};
@@ -262,6 +371,7 @@ void Server::start(){
             if(isRunning) cerr<<"Error accepting client connection\n";
             continue;
         }
+        tuning.applyToSocket(clientSocket,true);
         
         // Parse the request to get PID and other info
         try{
@@ -284,7 +394,29 @@ void Server::start(){
             int clientPid;
             ss>>protocol>>sizeKB>>clientPid;
 
-            ClientRequest clientReq={clientSocket,clientAddr,clientPid,protocol,sizeKB};
+            // Optional trailing field: CRC32C of the payload in hex
+            optional<uint32_t> expectedCrc;
+            uint32_t crcValue=0;
+            if(ss>>hex>>crcValue) expectedCrc=crcValue;
+
+            // Optional field after the CRC: requested compression; unknown modes fall back to none
+            CompressionMode compression=COMPRESSION_NONE;
+            string compressionName;
+            if(ss>>compressionName) {
+                try {
+                    compression=parseCompressionMode(compressionName);
+                } catch(const invalid_argument&) {
+                    compression=COMPRESSION_NONE;
+                }
+            }
+
+            // Optional field after the compression mode: the client's tuning profile name
+            string clientProfile="unknown";
+            string clientProfileName;
+            if(ss>>clientProfileName) clientProfile=TuningProfile::safeName(clientProfileName);
+
+            ClientRequest clientReq={clientSocket,clientAddr,clientPid,protocol,sizeKB,expectedCrc,
+                                     compression,clientProfile};
             
             {
                 lock_guard<mutex> lock(queueMutex);
@@ -350,8 +482,25 @@ void Server::shutdown(){
 
 
 int main(int argc,char* argv[]){
+    // Strip the optional trailing "--profile <name|file>" before positional parsing
+    string profileArg="default";
+    if(argc>=3&&string(argv[argc-2])=="--profile") {
+        profileArg=argv[argc-1];
+        argc-=2;
+    }
     if(argc<3||argc>4) {
-        cerr<<"Usage: "<<argv[0]<<" <ServerPort> <SchedulingPolicy (1-FCFS, 2-RR)> [CsvLogFile]\n";
+        cerr<<"Usage: "<<argv[0]<<" <ServerPort> <SchedulingPolicy (1-FCFS, 2-RR)> [CsvLogFile]"
+            <<" [--profile <name|file>]\n";
+        cerr<<"Built-in profiles:";
+        for(const string& name:TuningProfile::presetNames()) cerr<<" "<<name;
+        cerr<<"\n";
+        return 1;
+    }
+    TuningProfile profile;
+    try {
+        profile=TuningProfile::load(profileArg);
+    } catch(const exception& e) {
+        cerr<<"Error: "<<e.what()<<"\n";
         return 1;
     }
     int port=atoi(argv[1]);
@@ -363,7 +512,7 @@ int main(int argc,char* argv[]){
         logFileName=argv[3];
     }
 
-    Server server(port,policy,logFileName);
+    Server server(port,policy,logFileName,profile);
     if(!server.initialize()) {
         cerr<<"Failed to initialize server\n";
         return 1;
@@ -11,6 +11,9 @@
 #include <netinet/in.h>
 #include <fstream>
 #include <optional>
+#include <cstdint>
+#include "tuning.hh"
+#include "compress.hh"
 
 enum SchedulingPolicy {FCFS, RR};
 
@@ -20,20 +23,18 @@ struct ClientRequest {
     int clientPid;
     std::string protocol;
     int sizeKB;
+    std::optional<uint32_t> expectedCrc;  // CRC32C of the payload, if the client sent one
+    CompressionMode compression;
+    std::string clientProfile;  // tuning profile the client ran with
 };
 
 class Server {
 public:
-    Server(int port, SchedulingPolicy policy, std::optional<std::string> csvLogFileName)
-        : tcpPort(port), tcpSocket(-1), schedulingPolicy(policy), isRunning(false) {
+    Server(int port, SchedulingPolicy policy, std::optional<std::string> csvLogFileName,
+           const TuningProfile& profile = TuningProfile())
+        : tcpPort(port), tcpSocket(-1), schedulingPolicy(policy), isRunning(false), tuning(profile) {
         if (csvLogFileName) {
-            csvLogFile.open(*csvLogFileName, std::ios_base::app);
-            if (csvLogFile.is_open()) {
-                csvLogFile.seekp(0, std::ios::end);
-                if (csvLogFile.tellp() == 0) {
-                    csvLogFile << "Policy,Protocol,MessageSizeKB,TransferTimeMicroseconds,ThroughputKbps\n";
-                }
-            }
+            openCsvLog(*csvLogFileName);
         }
     }
 
@@ -49,15 +50,19 @@ public:
     void shutdown();
 
 private:
+    void openCsvLog(const std::string& fileName);
     void scheduler();
     void handleNegotiation(const ClientRequest& clientReq);
     void handleDataTransfer(const std::string& protocol, int sizeKB, int dataSocket, 
-                           const std::string& clientIp, int clientPid);
+                           const std::string& clientIp, int clientPid,
+                           std::optional<uint32_t> expectedCrc, CompressionMode compression,
+                           const std::string& clientProfile);
 
     int tcpPort;
     int tcpSocket;
     SchedulingPolicy schedulingPolicy;
     bool isRunning;
+    TuningProfile tuning;
 
     // FCFS: single queue, serve one client completely before next
     std::queue<int> fcfsClientOrder;  // PIDs in order
@@ -0,0 +1,224 @@
+#include "tuning.hh"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <cctype>
+
+using namespace std;
+
+
+static TuningProfile lowLatencyPreset() {
+    TuningProfile p;
+    p.name="low-latency";
+    p.tcpNoDelay=true;
+    p.tcpQuickAck=true;
+    p.recvBufferBytes=256*1024;
+    p.sendBufferBytes=256*1024;
+    p.busyPollMicros=50;
+    p.acceptCpu=0;
+    p.schedulerCpu=1;
+    // Client and server usually share a host in tests, so keep the sender off the receiver's core
+    p.workerCpu=2;
+    return p;
+}
+
+static TuningProfile bulkThroughputPreset() {
+    TuningProfile p;
+    p.name="bulk-throughput";
+    p.recvBufferBytes=4*1024*1024;
+    p.sendBufferBytes=4*1024*1024;
+    return p;
+}
+
+vector<string> TuningProfile::presetNames() {
+    return {"default","low-latency","bulk-throughput"};
+}
+
+string TuningProfile::safeName(const string& name) {
+    string out=name;
+    for(char& c:out) {
+        if(c==','||c=='"'||isspace(static_cast<unsigned char>(c))||iscntrl(static_cast<unsigned char>(c))) {
+            c='_';
+        }
+    }
+    return out.empty()? "unnamed":out;
+}
+
+static int parseInt(const string& key,const string& value) {
+    try {
+        size_t pos=0;
+        int v=stoi(value,&pos);
+        if(pos!=value.size()) throw invalid_argument(value);
+        return v;
+    } catch(const exception&) {
+        throw invalid_argument("Invalid value for '"+key+"': "+value);
+    }
+}
+
+static bool parseBool(const string& key,const string& value) {
+    if(value=="1"||value=="true"||value=="on") return true;
+    if(value=="0"||value=="false"||value=="off") return false;
+    throw invalid_argument("Invalid value for '"+key+"': "+value);
+}
+
+TuningProfile TuningProfile::load(const string& nameOrPath) {
+    if(nameOrPath=="default") return TuningProfile();
+    if(nameOrPath=="low-latency") return lowLatencyPreset();
+    if(nameOrPath=="bulk-throughput") return bulkThroughputPreset();
+
+    ifstream in(nameOrPath);
+    if(!in.is_open()) {
+        throw invalid_argument("Unknown tuning profile or unreadable file: "+nameOrPath);
+    }
+
+    // Layout: one key=value per line, '#' starts a comment.
+    // Unnamed files are labelled by their basename, not the full path
+    TuningProfile p;
+    size_t slash=nameOrPath.find_last_of('/');
+    p.name=safeName(slash==string::npos? nameOrPath:nameOrPath.substr(slash+1));
+    string line;
+    while(getline(in,line)) {
+        size_t hash=line.find('#');
+        if(hash!=string::npos) line.erase(hash);
+        size_t eq=line.find('=');
+        if(eq==string::npos) {
+            if(line.find_first_not_of(" \t\r")!=string::npos) {
+                throw invalid_argument("Malformed profile line: "+line);
+            }
+            continue;
+        }
+        string key,value;
+        stringstream(line.substr(0,eq))>>key;
+        stringstream(line.substr(eq+1))>>value;
+
+        if(key=="name") {
+            if(value.empty()||safeName(value)!=value) {
+                throw invalid_argument("Profile name must be non-empty without commas, quotes or spaces: "+value);
+            }
+            p.name=value;
+        }
+        else if(key=="tcp_nodelay") p.tcpNoDelay=parseBool(key,value);
+        else if(key=="tcp_quickack") p.tcpQuickAck=parseBool(key,value);
+        else if(key=="rcvbuf") p.recvBufferBytes=parseInt(key,value);
+        else if(key=="sndbuf") p.sendBufferBytes=parseInt(key,value);
+        else if(key=="busy_poll") p.busyPollMicros=parseInt(key,value);
+        else if(key=="accept_cpu") p.acceptCpu=parseInt(key,value);
+        else if(key=="scheduler_cpu") p.schedulerCpu=parseInt(key,value);
+        else if(key=="worker_cpu") p.workerCpu=parseInt(key,value);
+        else throw invalid_argument("Unknown profile key: "+key);
+    }
+    return p;
+}
+
+// Options are applied to every socket, so each distinct problem is reported once per process.
+static void warnOnce(const string& message) {
+    static mutex warnMutex;
+    static set<string> reported;
+    lock_guard<mutex> lock(warnMutex);
+    if(reported.insert(message).second) {
+        cerr<<"Warning: "<<message<<"\n";
+    }
+}
+
+static bool setIntOption(int sock,int level,int option,int value,const string& optionName) {
+    if(setsockopt(sock,level,option,&value,sizeof(value))<0) {
+        warnOnce("could not set "+optionName+" to "+to_string(value)+": "+strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Plain SO_RCVBUF/SO_SNDBUF are capped at net.core.rmem_max/wmem_max, so try the
+// privileged *FORCE variant first and read the result back to report clamping.
+static void setBufferSize(int sock,int option,int forceOption,int bytes,const string& optionName) {
+    bool forced=false;
+    if(forceOption>=0) {
+        forced=(setsockopt(sock,SOL_SOCKET,forceOption,&bytes,sizeof(bytes))==0);
+    }
+    if(!forced&&!setIntOption(sock,SOL_SOCKET,option,bytes,optionName)) return;
+
+    int actual=0;
+    socklen_t len=sizeof(actual);
+#ifdef __linux__
+    // Linux doubles the requested size for bookkeeping overhead and reports the doubled value
+    long long expected=2LL*bytes;
+#else
+    long long expected=bytes;
+#endif
+    if(getsockopt(sock,SOL_SOCKET,option,&actual,&len)==0&&actual<expected) {
+        warnOnce(optionName+" requested "+to_string(bytes)+" bytes but the kernel granted "+
+                 to_string(actual)+" (raise net.core."+(option==SO_RCVBUF? "rmem_max":"wmem_max")+
+                 " or run with CAP_NET_ADMIN)");
+    }
+}
+
+#ifdef SO_RCVBUFFORCE
+static const int kRcvBufForce=SO_RCVBUFFORCE;
+static const int kSndBufForce=SO_SNDBUFFORCE;
+#else
+static const int kRcvBufForce=-1;
+static const int kSndBufForce=-1;
+#endif
+
+void TuningProfile::setSendBufferSize(int sock,int bytes) {
+    setBufferSize(sock,SO_SNDBUF,kSndBufForce,bytes,"SO_SNDBUF");
+}
+
+void TuningProfile::applyToSocket(int sock,bool isTcp) const {
+    if(recvBufferBytes>0) {
+        setBufferSize(sock,SO_RCVBUF,kRcvBufForce,recvBufferBytes,"SO_RCVBUF");
+    }
+    if(sendBufferBytes>0) {
+        setSendBufferSize(sock,sendBufferBytes);
+    }
+    if(busyPollMicros>0) {
+#ifdef SO_BUSY_POLL
+        setIntOption(sock,SOL_SOCKET,SO_BUSY_POLL,busyPollMicros,"SO_BUSY_POLL");
+#else
+        warnOnce("SO_BUSY_POLL is not supported on this platform");
+#endif
+    }
+    if(isTcp&&tcpNoDelay) {
+        setIntOption(sock,IPPROTO_TCP,TCP_NODELAY,1,"TCP_NODELAY");
+    }
+    if(isTcp) rearmQuickAck(sock);
+}
+
+void TuningProfile::rearmQuickAck(int sock) const {
+#ifdef TCP_QUICKACK
+    if(tcpQuickAck) {
+        setIntOption(sock,IPPROTO_TCP,TCP_QUICKACK,1,"TCP_QUICKACK");
+    }
+#else
+    (void)sock;
+    if(tcpQuickAck) warnOnce("TCP_QUICKACK is not supported on this platform");
+#endif
+}
+
+void TuningProfile::pinCurrentThread(int cpu,const string& role) {
+    if(cpu<0) return;
+#ifdef __linux__
+    if(cpu>=CPU_SETSIZE) {
+        cerr<<"Warning: CPU "<<cpu<<" for "<<role<<" thread is out of range\n";
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu,&set);
+    if(pthread_setaffinity_np(pthread_self(),sizeof(set),&set)!=0) {
+        cerr<<"Warning: could not pin "<<role<<" thread to CPU "<<cpu<<"\n";
+    }
+#else
+    cerr<<"Warning: CPU affinity for "<<role<<" thread is not supported on this platform\n";
+#endif
+}
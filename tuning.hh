@@ -0,0 +1,37 @@
+#ifndef TUNING_HH
+#define TUNING_HH
+
+#include <string>
+#include <vector>
+
+// Socket and CPU tuning applied to the control, data and scheduler paths.
+// A zero buffer size or busy-poll budget and a negative CPU leave the
+// kernel default untouched.
+struct TuningProfile {
+    std::string name="default";
+    bool tcpNoDelay=false;
+    bool tcpQuickAck=false;
+    int recvBufferBytes=0;
+    int sendBufferBytes=0;
+    int busyPollMicros=0;
+    int acceptCpu=-1;
+    int schedulerCpu=-1;
+    int workerCpu=-1;
+
+    // Resolves a built-in preset name or a key=value profile file.
+    // Throws invalid_argument if neither matches.
+    static TuningProfile load(const std::string& nameOrPath);
+    static std::vector<std::string> presetNames();
+    // Replaces characters that would break a CSV field or a negotiation token.
+    static std::string safeName(const std::string& name);
+
+    void applyToSocket(int sock,bool isTcp) const;
+    // Sets SO_SNDBUF the same way applyToSocket does: FORCE first, warn if clamped.
+    static void setSendBufferSize(int sock,int bytes);
+    // TCP_QUICKACK is not sticky on Linux, so it has to be re-armed after reads.
+    void rearmQuickAck(int sock) const;
+    static void pinCurrentThread(int cpu,const std::string& role);
+};
+
+
+#endif